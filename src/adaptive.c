@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2026 GHC contributors
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * Adaptive compression
+ *
+ * Moves between the compress_level() search effort levels depending on the
+ * measured compression time.
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "adaptive.h"
+
+/*
+ * Initiates the state for adaptive compression
+ *
+ * @param [out] state      State to initiate
+ * @param [in]  target_ns  Per packet time budget in nanoseconds
+ *
+ */
+void adaptive_init(adaptive_t *state, long target_ns)
+{
+    memset(state, 0, sizeof(*state));
+    state->target_ns = target_ns;
+    state->level = LEVEL_FULL;
+    state->backoff = 1;
+    for (int level = LEVEL_FULL; level <= LEVEL_RAW; level++) {
+        state->average_ns[level] = -1;
+    }
+}
+
+static long elapsed_ns(struct timespec *start, struct timespec *end)
+{
+    return (end->tv_sec - start->tv_sec) * 1000000000L + (end->tv_nsec - start->tv_nsec);
+}
+
+/*
+ * Compresses the payload at the current level of the adaptive state and
+ * feeds the measured time to adaptive_update()
+ *
+ * @param [in,out] state            Adaptive state
+ * @param [out]    comp_buf         Buffer where to put the compressed result
+ * @param [in]     hdr              48-byte long header
+ * @param [in]     payload          Buffer to compress
+ * @param [in]     payload_buf_len  Length of payload_buf
+ *
+ * @return Length of the compressed result
+ */
+int compress_adaptive(adaptive_t *state, uint8_t *comp_buf, uint8_t *hdr, uint8_t *payload_buf, int payload_buf_len)
+{
+    struct timespec start, end;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int comp_buf_len = compress_level(comp_buf, hdr, payload_buf, payload_buf_len, state->level);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    adaptive_update(state, payload_buf_len, comp_buf_len, elapsed_ns(&start, &end));
+    return comp_buf_len;
+}
+
+/*
+ * Accounts a packet compressed at the current level and moves between
+ * levels so that the average cost stays within the budget.
+ *
+ * Every level keeps its own moving average across level changes, with every
+ * packet counting at most twice the budget. The level is lowered (less
+ * search) once ADAPTIVE_SAMPLES packets were compressed at it and its
+ * average is over the budget. After ADAPTIVE_CALM packets below
+ * half of the budget the level is raised again to probe it. Every probe
+ * that has to be lowered right away doubles the number of calm packets
+ * needed for the next one, up to ADAPTIVE_CALM * ADAPTIVE_BACKOFF.
+ *
+ * @param [in,out] state            Adaptive state
+ * @param [in]     payload_buf_len  Length of the compressed payload
+ * @param [in]     comp_buf_len     Length of the compressed result
+ * @param [in]     ns               Time the compression took
+ *
+ */
+void adaptive_update(adaptive_t *state, int payload_buf_len, int comp_buf_len, long ns)
+{
+    int level = state->level;
+
+    state->packets[level]++;
+    state->payload_bytes[level] += payload_buf_len;
+    state->compressed_bytes[level] += comp_buf_len;
+
+    if (state->target_ns > 0 && ns > 2 * state->target_ns) {
+        /* One preempted packet must not push the average over the budget */
+        ns = 2 * state->target_ns;
+    }
+    long *average_ns = state->average_ns;
+    if (average_ns[level] < 0) {
+        average_ns[level] = ns;
+    } else {
+        average_ns[level] += (ns - average_ns[level]) / 8;
+    }
+    state->settled++;
+
+    if (state->settled < ADAPTIVE_SAMPLES) {
+        /* Too few samples at this level to decide */
+    } else if (average_ns[level] > state->target_ns && level < LEVEL_RAW) {
+        /* Over budget, search less */
+        if (state->probing && state->backoff < ADAPTIVE_BACKOFF) {
+            state->backoff *= 2;
+        }
+        state->level++;
+        state->settled = 0;
+        state->calm = 0;
+        state->probing = 0;
+        state->changes++;
+    } else {
+        if (state->probing) {
+            /* The probed level fits the budget */
+            state->backoff = 1;
+            state->probing = 0;
+        }
+        if (average_ns[level] < state->target_ns / 2 && level > LEVEL_FULL) {
+            /* Well below budget, try to search more */
+            if (++state->calm >= ADAPTIVE_CALM * state->backoff) {
+                state->level--;
+                state->settled = 0;
+                state->calm = 0;
+                state->probing = 1;
+                state->changes++;
+            }
+        } else {
+            state->calm = 0;
+        }
+    }
+
+    if (DEBUG) {
+        printf("level %d: %ld ns (avg %ld ns)\n", level, ns, average_ns[level]);
+    }
+}
+
+/*
+ * Estimates the compression given up by running below LEVEL_FULL
+ *
+ * The ratio reached by packets at LEVEL_FULL is taken as reference for the
+ * packets compressed at lower levels. This assumes the packets at both
+ * levels are alike; under sustained overload only a few packets, mostly
+ * from before the overload, are compressed at LEVEL_FULL, so the estimate
+ * follows the traffic mix of that time.
+ *
+ * @param [in] state  Adaptive state
+ *
+ * @return Additional compressed bytes relative to all payload bytes, -1 if
+ *         fewer than ADAPTIVE_REFERENCE packets were compressed at LEVEL_FULL
+ */
+double adaptive_ratio_lost(adaptive_t *state)
+{
+    long payload_total = 0;
+    double lost = 0;
+
+    if (state->packets[LEVEL_FULL] < ADAPTIVE_REFERENCE || state->payload_bytes[LEVEL_FULL] == 0) {
+        return -1;
+    }
+    double full_ratio = (double)state->compressed_bytes[LEVEL_FULL] / state->payload_bytes[LEVEL_FULL];
+
+    for (int level = LEVEL_FULL; level <= LEVEL_RAW; level++) {
+        payload_total += state->payload_bytes[level];
+        if (level > LEVEL_FULL) {
+            lost += state->compressed_bytes[level] - state->payload_bytes[level] * full_ratio;
+        }
+    }
+    return lost / payload_total;
+}
@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2026 GHC contributors
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @brief Adaptive compression
+ * Picks the compress_level() search effort per packet so that the average
+ * compression time stays within a budget.
+ */
+
+#ifndef GHC_adaptive_h
+#define GHC_adaptive_h
+
+#include "ghc.h"
+
+#define ADAPTIVE_SAMPLES    8
+#define ADAPTIVE_CALM       32
+#define ADAPTIVE_BACKOFF    64
+#define ADAPTIVE_REFERENCE  16
+
+typedef struct {
+    long target_ns;
+    int level;
+    long average_ns[LEVEL_RAW + 1];     /* Moving average per level, -1 before the first packet */
+    int settled;                        /* Packets since the last level change */
+    int calm;                           /* Packets below half of the budget */
+    int probing;                        /* Level was raised to probe it */
+    int backoff;                        /* Calm periods needed before the next probe */
+    long changes;
+    long packets[LEVEL_RAW + 1];
+    long payload_bytes[LEVEL_RAW + 1];
+    long compressed_bytes[LEVEL_RAW + 1];
+} adaptive_t;
+
+void adaptive_init(adaptive_t *state, long target_ns);
+int compress_adaptive(adaptive_t *state, uint8_t *comp_buf, uint8_t *hdr, uint8_t *payload_buf, int payload_buf_len);
+void adaptive_update(adaptive_t *state, int payload_buf_len, int comp_buf_len, long ns);
+double adaptive_ratio_lost(adaptive_t *state);
+
+#endif
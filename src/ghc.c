@@ -23,6 +23,9 @@
 
 #include "ghc.h"
 
+static int decompress_buffer(uint8_t *decomp_buf, int decomp_buf_size, int *decomp_buf_index_ptr, uint8_t *comp_buf, int comp_buf_len);
+static int compress_buffer(uint8_t *comp_buf, uint8_t *buffer, int payload_buf_len, int level);
+
 /*
  * Initiates the dictionary buffer composed out of the pseudo header and a static dictionary
  *
@@ -46,7 +49,8 @@ void dictionary_buffer_init(uint8_t* comp_buf, uint8_t* hdr)
 /*
  * Decompresses the payload
  *
- * @param [out] decomp_buf    Buffer where to put the decompressed result
+ * @param [out] decomp_buf    Buffer where to put the decompressed result, at
+ *                            least BUFFERSIZE bytes
  * @param [in]  hdr           48-byte long header
  * @param [in]  comp_buf      Buffer to decompress
  * @param [in]  comp_buf_len  Length of comp_buf
@@ -56,19 +60,59 @@ void decompress(uint8_t *decomp_buf, uint8_t *hdr, uint8_t *comp_buf, int comp_b
 {
     int decomp_buf_index = 48;
     dictionary_buffer_init(decomp_buf, hdr);
-    
+
+    int i = decompress_buffer(decomp_buf, BUFFERSIZE, &decomp_buf_index, comp_buf, comp_buf_len);
+    if (i >= 0 && i < comp_buf_len && decomp_buf_index + comp_buf_len - i - 1 <= BUFFERSIZE) {
+        /* STOP code, the rest is not compressed */
+        memcpy(&decomp_buf[decomp_buf_index], &comp_buf[i+1], comp_buf_len - i - 1);
+        decomp_buf_index += comp_buf_len - i - 1;
+    }
+
+    if (DEBUG) {
+        printf("--------\n");
+        for (int x = 48; x < decomp_buf_index; x++) {
+            printf("%02x ", (unsigned char)decomp_buf[x]);
+        }
+        printf("\n--------\n");
+    }
+}
+
+/*
+ * Decompresses into a buffer already holding the dictionary, up to the end
+ * of comp_buf or the first STOP code
+ *
+ * @param [in,out] decomp_buf            Buffer starting with the dictionary
+ * @param [in]     decomp_buf_size       Size of decomp_buf
+ * @param [in,out] decomp_buf_index_ptr  Where to put the next decompressed byte
+ * @param [in]     comp_buf              Buffer to decompress
+ * @param [in]     comp_buf_len          Length of comp_buf
+ *
+ * @return Index of the STOP code in comp_buf or comp_buf_len, -1 if an
+ *         opcode reads past comp_buf, writes past decomp_buf_size or refers
+ *         before the start of decomp_buf
+ */
+static int decompress_buffer(uint8_t *decomp_buf, int decomp_buf_size, int *decomp_buf_index_ptr, uint8_t *comp_buf, int comp_buf_len)
+{
+    int decomp_buf_index = *decomp_buf_index_ptr;
     int na = 0x00, sa = 0x00;
     int n = 0, s = 0;
+    int i;
     
-    for (int i = 0; i < comp_buf_len; i++) {
+    for (i = 0; i < comp_buf_len; i++) {
         if ((comp_buf[i] & 0x80) == 0x00) {
             /* Append k bytes of data */
+            if (i + comp_buf[i] >= comp_buf_len || decomp_buf_index + comp_buf[i] > decomp_buf_size) {
+                return -1;
+            }
             memcpy(&decomp_buf[decomp_buf_index], &comp_buf[i+1], comp_buf[i]);
             decomp_buf_index += comp_buf[i];
             i += comp_buf[i];
             continue;
         } else if ((comp_buf[i] & 0xF0) == 0x80) {
             /* Append n + 2 bytes of zeroes */
+            if (decomp_buf_index + (comp_buf[i] & 0x0F) + 2 > decomp_buf_size) {
+                return -1;
+            }
             memset(&decomp_buf[decomp_buf_index], 0x00, (comp_buf[i] & 0x0F) + 2);
             decomp_buf_index += (comp_buf[i] & 0x0F) + 2;
             continue;
@@ -81,24 +125,277 @@ void decompress(uint8_t *decomp_buf, uint8_t *hdr, uint8_t *comp_buf, int comp_b
             /* Back reference */
             n = na + ((comp_buf[i] & 0x38) >> 3) + 2;
             s = (comp_buf[i] & 0x07) + sa + n;
+            if (decomp_buf_index - s < 0 || decomp_buf_index + n > decomp_buf_size) {
+                return -1;
+            }
             memcpy(&decomp_buf[decomp_buf_index], &decomp_buf[decomp_buf_index - s], n);
             decomp_buf_index += n;
             na = 0x00;
             sa = 0x00;
             continue;
         } else if ((comp_buf[i] & 0xFF) == 0x90) {
-            /* STOP code, not implemented yet */
+            /* STOP code */
+            break;
+        }
+    }
+
+    *decomp_buf_index_ptr = decomp_buf_index;
+    return i;
+}
+
+/*
+ * Walks the opcode stream once and records where every opcode puts its bytes
+ *
+ * @param [out] segments      Segment table, at least comp_buf_len entries
+ * @param [in]  comp_buf      Compressed payload
+ * @param [in]  comp_buf_len  Length of comp_buf
+ *
+ * @return Number of segments, -1 if a COPY passes the end of comp_buf or a
+ *         BACKREF reaches before the dictionary
+ */
+static int segment_table(segment_t *segments, uint8_t *comp_buf, int comp_buf_len)
+{
+    int count = 0;
+    int buffer_index = 48;
+    int na = 0x00, sa = 0x00;
+
+    for (int i = 0; i < comp_buf_len; i++) {
+        segment_t *segment = &segments[count];
+        segment->start = buffer_index;
+
+        if ((comp_buf[i] & 0x80) == 0x00) {
+            if (i + comp_buf[i] >= comp_buf_len) {
+                /* Run passes the end of comp_buf */
+                return -1;
+            }
+            segment->code = COPY;
+            segment->length = comp_buf[i];
+            segment->source = i + 1;
+            i += comp_buf[i];
+        } else if ((comp_buf[i] & 0xF0) == 0x80) {
+            segment->code = ZERO;
+            segment->length = (comp_buf[i] & 0x0F) + 2;
+        } else if ((comp_buf[i] & 0xE0) == 0xA0) {
+            na += (comp_buf[i] & 0x10) >> 1;
+            sa += (comp_buf[i] & 0x0F) << 3;
             continue;
+        } else if ((comp_buf[i] & 0xC0) == 0xC0) {
+            segment->code = BACKREF;
+            segment->length = na + ((comp_buf[i] & 0x38) >> 3) + 2;
+            segment->source = (comp_buf[i] & 0x07) + sa + segment->length;
+            if (segment->source > buffer_index) {
+                /* Reference before the start of the dictionary */
+                return -1;
+            }
+            na = 0x00;
+            sa = 0x00;
+        } else {
+            /* STOP code, the rest is one uncompressed run */
+            segment->code = COPY;
+            segment->length = comp_buf_len - i - 1;
+            segment->source = i + 1;
+            i = comp_buf_len;
         }
+        buffer_index += segment->length;
+        count++;
     }
+    return count;
+}
 
-    if (DEBUG) {
-        printf("--------\n");
-        for (int x = 48; x < decomp_buf_index; x++) {
-            printf("%02x ", (unsigned char)decomp_buf[x]);
+/*
+ * Binary search for the segment holding buffer_index
+ */
+static int find_segment(inspect_t *inspect, int buffer_index)
+{
+    int low = 0, high = inspect->segment_count - 1;
+
+    while (low < high) {
+        int mid = (low + high + 1) / 2;
+        if (inspect->segments[mid].start <= buffer_index) {
+            low = mid;
+        } else {
+            high = mid - 1;
         }
-        printf("\n--------\n");
     }
+    return low;
+}
+
+/*
+ * Resolves a single buffer index, following back references until a COPY,
+ * ZERO or dictionary byte is hit
+ */
+static uint8_t resolve_byte(inspect_t *inspect, int buffer_index)
+{
+    while (buffer_index >= 48) {
+        segment_t *segment = &inspect->segments[find_segment(inspect, buffer_index)];
+
+        if (segment->code == COPY) {
+            return inspect->comp_buf[segment->source + buffer_index - segment->start];
+        } else if (segment->code == ZERO) {
+            return 0x00;
+        }
+        /* s >= n, so the source always lies in an earlier segment */
+        buffer_index -= segment->source;
+    }
+    return inspect->dictionary[buffer_index];
+}
+
+/*
+ * Prepares a compressed payload for inspection. The opcode stream is walked
+ * once, after that any number of inspect_range() and inspect_byte() calls
+ * only touch the opcodes covering the requested bytes.
+ *
+ * @param [out] inspect       Inspection state, refers to segments and comp_buf
+ * @param [out] segments      Segment table, at least comp_buf_len entries
+ * @param [in]  hdr           48-byte long header
+ * @param [in]  comp_buf      Buffer to inspect
+ * @param [in]  comp_buf_len  Length of comp_buf
+ *
+ * @return Length of the decompressed payload, -1 if comp_buf is malformed
+ */
+int inspect_init(inspect_t *inspect, segment_t *segments, uint8_t *hdr, uint8_t *comp_buf, int comp_buf_len)
+{
+    dictionary_buffer_init(inspect->dictionary, hdr);
+    inspect->comp_buf = comp_buf;
+    inspect->segments = segments;
+    inspect->segment_count = segment_table(segments, comp_buf, comp_buf_len);
+    inspect->payload_len = 0;
+
+    if (inspect->segment_count < 0) {
+        inspect->segment_count = 0;
+        return -1;
+    }
+    if (inspect->segment_count > 0) {
+        segment_t *last = &segments[inspect->segment_count - 1];
+        inspect->payload_len = last->start + last->length - 48;
+    }
+    return inspect->payload_len;
+}
+
+/*
+ * Decompresses only a range of the payload without decompressing the rest.
+ * COPY and ZERO runs are put out in one step, back references are only
+ * resolved for bytes inside the range.
+ *
+ * @param [in]  inspect    State set up by inspect_init()
+ * @param [out] range_buf  Buffer where to put the decompressed range
+ * @param [in]  offset     Payload offset of the first requested byte
+ * @param [in]  length     Number of requested bytes
+ *
+ * @return Number of bytes put in range_buf, less than length if the range
+ *         passes the end of the payload
+ */
+int inspect_range(inspect_t *inspect, uint8_t *range_buf, int offset, int length)
+{
+    if (offset < 0 || length <= 0 || offset >= inspect->payload_len) {
+        return 0;
+    }
+    if (length > inspect->payload_len - offset) {
+        length = inspect->payload_len - offset;
+    }
+
+    int range_start = offset + 48;
+    int range_end = range_start + length;
+
+    for (int k = find_segment(inspect, range_start); k < inspect->segment_count; k++) {
+        segment_t *segment = &inspect->segments[k];
+        int start = segment->start;
+        int end = start + segment->length;
+
+        if (start >= range_end) {
+            break;
+        }
+        if (start < range_start) {
+            start = range_start;
+        }
+        if (end > range_end) {
+            end = range_end;
+        }
+
+        if (segment->code == COPY) {
+            memcpy(&range_buf[start - range_start], &inspect->comp_buf[segment->source + start - segment->start], end - start);
+        } else if (segment->code == ZERO) {
+            memset(&range_buf[start - range_start], 0x00, end - start);
+        } else {
+            for (int x = start; x < end; x++) {
+                int source = x - segment->source;
+                if (source >= range_start) {
+                    /* Already decompressed into range_buf */
+                    range_buf[x - range_start] = range_buf[source - range_start];
+                } else {
+                    range_buf[x - range_start] = resolve_byte(inspect, source);
+                }
+            }
+        }
+    }
+    return length;
+}
+
+/*
+ * Decompresses a single payload byte
+ *
+ * @param [in]  inspect  State set up by inspect_init()
+ * @param [in]  offset   Payload offset of the requested byte
+ *
+ * @return The byte value (0-255) or -1 if offset is outside the payload
+ */
+int inspect_byte(inspect_t *inspect, int offset)
+{
+    if (offset < 0 || offset >= inspect->payload_len) {
+        return -1;
+    }
+    return resolve_byte(inspect, offset + 48) & 0xFF;
+}
+
+/*
+ * Decompresses only a range of the payload, see inspect_range(). Use
+ * inspect_init() instead when reading more than one field of a payload.
+ *
+ * @param [out] range_buf     Buffer where to put the decompressed range
+ * @param [in]  hdr           48-byte long header
+ * @param [in]  comp_buf      Buffer to inspect
+ * @param [in]  comp_buf_len  Length of comp_buf
+ * @param [in]  offset        Payload offset of the first requested byte
+ * @param [in]  length        Number of requested bytes
+ *
+ * @return Number of bytes put in range_buf, less than length if the range
+ *         passes the end of the payload
+ */
+int decompress_range(uint8_t *range_buf, uint8_t *hdr, uint8_t *comp_buf, int comp_buf_len,
+                     int offset, int length)
+{
+    if (comp_buf_len <= 0) {
+        return 0;
+    }
+
+    inspect_t inspect;
+    segment_t segments[comp_buf_len + 1];
+
+    inspect_init(&inspect, segments, hdr, comp_buf, comp_buf_len);
+    return inspect_range(&inspect, range_buf, offset, length);
+}
+
+/*
+ * Decompresses a single payload byte, see inspect_byte()
+ *
+ * @param [in]  hdr           48-byte long header
+ * @param [in]  comp_buf      Buffer to inspect
+ * @param [in]  comp_buf_len  Length of comp_buf
+ * @param [in]  offset        Payload offset of the requested byte
+ *
+ * @return The byte value (0-255) or -1 if offset is outside the payload
+ */
+int decompress_byte(uint8_t *hdr, uint8_t *comp_buf, int comp_buf_len, int offset)
+{
+    if (comp_buf_len <= 0) {
+        return -1;
+    }
+
+    inspect_t inspect;
+    segment_t segments[comp_buf_len + 1];
+
+    inspect_init(&inspect, segments, hdr, comp_buf, comp_buf_len);
+    return inspect_byte(&inspect, offset);
 }
 
 /*
@@ -109,13 +406,57 @@ void decompress(uint8_t *decomp_buf, uint8_t *hdr, uint8_t *comp_buf, int comp_b
  * @param [in]  payload           Buffer to compress
  * @param [in]  payload_buf_len   Length of payload_buf
  *
+ * @return Length of the compressed result
+ */
+int compress(uint8_t *comp_buf, uint8_t *hdr, uint8_t *payload_buf, int payload_buf_len)
+{
+    return compress_level(comp_buf, hdr, payload_buf, payload_buf_len, LEVEL_FULL);
+}
+
+/*
+ * Compresses the payload with a given search effort
+ *
+ * LEVEL_FULL searches the whole dictionary and payload history,
+ * LEVEL_BOUNDED only the last BOUNDED_WINDOW bytes, LEVEL_ZERO only
+ * encodes zero runs and LEVEL_RAW sends the payload uncompressed after
+ * a STOP code.
+ *
+ * @param [out] comp_buf          Buffer where to put the compressed result
+ * @param [in]  hdr               48-byte long header
+ * @param [in]  payload           Buffer to compress
+ * @param [in]  payload_buf_len   Length of payload_buf
+ * @param [in]  level             One of the LEVEL_ values
+ *
+ * @return Length of the compressed result
  */
-void compress(uint8_t *comp_buf, uint8_t *hdr, uint8_t *payload_buf, int payload_buf_len)
+int compress_level(uint8_t *comp_buf, uint8_t *hdr, uint8_t *payload_buf, int payload_buf_len, int level)
 {
+    if (level >= LEVEL_RAW) {
+        comp_buf[0] = STOP;
+        memcpy(&comp_buf[1], payload_buf, payload_buf_len);
+        return payload_buf_len + 1;
+    }
+
     uint8_t buffer[48+payload_buf_len];
     dictionary_buffer_init(buffer, hdr);
     memcpy(&buffer[48], payload_buf, payload_buf_len);
-    
+
+    return compress_buffer(comp_buf, buffer, payload_buf_len, level);
+}
+
+/*
+ * Compresses the payload placed right after the dictionary in buffer
+ *
+ * @param [out] comp_buf          Buffer where to put the compressed result
+ * @param [in]  buffer            Dictionary followed by the payload
+ * @param [in]  payload_buf_len   Length of the payload
+ * @param [in]  level             LEVEL_FULL, LEVEL_BOUNDED or LEVEL_ZERO
+ *
+ * @return Length of the compressed result
+ */
+static int compress_buffer(uint8_t *comp_buf, uint8_t *buffer, int payload_buf_len, int level)
+{
+    uint8_t *payload_buf = &buffer[48];
     int buffer_index = 0;
     int copy_buffer = 0;
     int payload_index = 0;
@@ -123,7 +464,7 @@ void compress(uint8_t *comp_buf, uint8_t *hdr, uint8_t *payload_buf, int payload
     for (int i = 0; i < payload_buf_len; i++) {
         /* Count zero sequence */
         int zero_sequence = 0;
-        for (int z = i; z<i+17; z++) {
+        for (int z = i; z<i+17 && z < payload_buf_len; z++) {
             if (payload_buf[z] == 0x00) {
                 zero_sequence++;
             } else {
@@ -135,9 +476,16 @@ void compress(uint8_t *comp_buf, uint8_t *hdr, uint8_t *payload_buf, int payload
         int index = 0, index_best = 0;
         int append = 0, append_best = 0;
 
-        for (int dictionary_index = 0; dictionary_index < i+48;) {
+        int search_start = 0;
+        if (level == LEVEL_BOUNDED && i + 48 > BOUNDED_WINDOW) {
+            search_start = i + 48 - BOUNDED_WINDOW;
+        } else if (level == LEVEL_ZERO) {
+            search_start = i + 48;
+        }
+
+        for (int dictionary_index = search_start; dictionary_index < i+48;) {
                 /* First match and not the last byte in payload */
-            if ((payload_index < payload_buf_len) && (append == 0) && (((i+48) - dictionary_index) > 1) &&
+            if ((payload_index + 1 < payload_buf_len) && (append == 0) && (((i+48) - dictionary_index) > 1) &&
                 /* Matching pair */
                 ((payload_buf[payload_index] == buffer[dictionary_index]) && (payload_buf[payload_index+1] == buffer[dictionary_index+1]))) {
                 /* Found first matching pair */
@@ -166,7 +514,7 @@ void compress(uint8_t *comp_buf, uint8_t *hdr, uint8_t *payload_buf, int payload
                 payload_index++;
 
                 continue;
-            } else if ((append > 0) && (payload_buf[payload_index] != buffer[dictionary_index])) {
+            } else if ((append > 0) && ((payload_index >= payload_buf_len) || (payload_buf[payload_index] != buffer[dictionary_index]))) {
                 /* Set best match */
                 if (append >= append_best) {
                     append_best = append;
@@ -218,8 +566,9 @@ void compress(uint8_t *comp_buf, uint8_t *hdr, uint8_t *payload_buf, int payload
             if (n > 7 || s > 9) {
                 times_n = n / 8;
                 rest_n = n % 8;
-                times_s = s / 120;
-                rest_s = s % 120;
+                /* Offset is encoded as s - 2, split it before masking */
+                times_s = (s - 2) / 120;
+                rest_s = (s - 2) % 120;
                 
                 /* Send */
                 while (times_s > 0) {
@@ -242,17 +591,21 @@ void compress(uint8_t *comp_buf, uint8_t *hdr, uint8_t *payload_buf, int payload
                 }
                 
                 /* Mask rest_s */
-                extended_backref += ((rest_s - 2) & 0x78) >> 3;
-                memset(&comp_buf[buffer_index], extended_backref, 1);
-                buffer_index++;
+                extended_backref += (rest_s & 0x78) >> 3;
+                if ((extended_backref & 0xFF) != 0xa0) {
+                    /* A bare 0xa0 adds nothing after the full offset steps */
+                    memset(&comp_buf[buffer_index], extended_backref, 1);
+                    buffer_index++;
+                }
                 
                 while (times_n > 0) {
                     extended_backref = 0xb0;
+                    times_n--;
                     memset(&comp_buf[buffer_index], extended_backref, 1);
                     buffer_index++;
                 }
                 
-                backref += (rest_n << 3) + ((rest_s - 2) & 0x07);
+                backref += (rest_n << 3) + (rest_s & 0x07);
                 
                 memset(&comp_buf[buffer_index], backref, 1);
                 buffer_index++;
@@ -283,7 +636,9 @@ void compress(uint8_t *comp_buf, uint8_t *hdr, uint8_t *payload_buf, int payload
     
         } else {
             /* No dictionary match or zero sequence found, copy instead */
-            if (copy_buffer == 0) {
+            if (copy_buffer == 0 || copy_buffer == 127) {
+                /* Start a new copy run, k is limited to 7 bits */
+                copy_buffer = 0;
                 /* Set copy byte code */
                 memset(&comp_buf[buffer_index], 0x00 + copy_buffer + 1, 1);
                 buffer_index++;
@@ -311,4 +666,178 @@ void compress(uint8_t *comp_buf, uint8_t *hdr, uint8_t *payload_buf, int payload
         }
         printf("\n--------\n");
     }
+    return buffer_index;
+}
+
+/*
+ * NHC extension header ID (EID) of a next header value, -1 if it is not an
+ * extension header GHC can compress
+ */
+static int extension_id(int next_header)
+{
+    switch (next_header) {
+        case NEXT_HEADER_HOP_BY_HOP:
+            return 0;
+        case NEXT_HEADER_ROUTING:
+            return 1;
+        case NEXT_HEADER_FRAGMENT:
+            return 2;
+        case NEXT_HEADER_DEST_OPTIONS:
+            return 3;
+        case NEXT_HEADER_MOBILITY:
+            return 4;
+        default:
+            return -1;
+    }
+}
+
+/*
+ * Whether an extension header is a Fragment header with a nonzero offset.
+ * Only the first fragment starts with the next header, in later fragments
+ * the rest is carried inline.
+ */
+static int later_fragment(int eid, uint8_t *ext_buf)
+{
+    return eid == 2 && ((ext_buf[2] & 0xFF) << 8 | (ext_buf[3] & 0xFF)) & 0xFFF8;
+}
+
+/*
+ * Compresses the header chain following the IPv6 header in one pass.
+ *
+ * Every extension header is put out as NHC_EXT with its EID, compressed and
+ * terminated by a STOP code. A UDP or ICMPv6 header is put out as NHC_UDP or
+ * NHC_ICMPV6 and compressed together with the rest of the packet. Anything
+ * following an other next header or a Fragment header with a nonzero
+ * offset is appended uncompressed. The dictionary
+ * is set up once and shared by all headers.
+ *
+ * @param [out] comp_buf       Buffer where to put the result, to be placed after IPHC
+ * @param [in]  hdr            40-byte IPv6 header, hdr[6] is the first next header
+ * @param [in]  chain_buf      Everything following the IPv6 header
+ * @param [in]  chain_buf_len  Length of chain_buf
+ *
+ * @return Length of the result or -1 if an extension header is truncated
+ */
+int compress_chain(uint8_t *comp_buf, uint8_t *hdr, uint8_t *chain_buf, int chain_buf_len)
+{
+    uint8_t buffer[48+chain_buf_len];
+    int next_header = hdr[6] & 0xFF;
+    int chain_index = 0;
+    int comp_buf_index = 0;
+
+    dictionary_buffer_init(buffer, hdr);
+
+    while (chain_index < chain_buf_len) {
+        int eid = extension_id(next_header);
+        int element_len;
+
+        if (eid >= 0) {
+            if (chain_buf_len - chain_index < 8) {
+                return -1;
+            }
+            element_len = next_header == NEXT_HEADER_FRAGMENT ? 8 : ((chain_buf[chain_index + 1] & 0xFF) + 1) * 8;
+            if (element_len > chain_buf_len - chain_index) {
+                return -1;
+            }
+            comp_buf[comp_buf_index++] = NHC_EXT | (eid << 1);
+        } else if (next_header == NEXT_HEADER_UDP || next_header == NEXT_HEADER_ICMPV6) {
+            element_len = chain_buf_len - chain_index;
+            comp_buf[comp_buf_index++] = next_header == NEXT_HEADER_UDP ? NHC_UDP : NHC_ICMPV6;
+        } else {
+            /* Not compressible, carried inline */
+            memcpy(&comp_buf[comp_buf_index], &chain_buf[chain_index], chain_buf_len - chain_index);
+            comp_buf_index += chain_buf_len - chain_index;
+            break;
+        }
+
+        memcpy(&buffer[48], &chain_buf[chain_index], element_len);
+        comp_buf_index += compress_buffer(&comp_buf[comp_buf_index], buffer, element_len, LEVEL_FULL);
+
+        if (eid >= 0) {
+            comp_buf[comp_buf_index++] = STOP;
+            next_header = chain_buf[chain_index] & 0xFF;
+            if (later_fragment(eid, &chain_buf[chain_index])) {
+                /* Not a next header value, the rest is carried inline */
+                next_header = -1;
+            }
+        }
+        chain_index += element_len;
+    }
+    return comp_buf_index;
+}
+
+/*
+ * Decompresses a header chain compressed by compress_chain()
+ *
+ * @param [out] chain_buf       Buffer where to put the header chain
+ * @param [in]  chain_buf_size  Size of chain_buf
+ * @param [in]  hdr             40-byte IPv6 header, hdr[6] is the first next header
+ * @param [in]  comp_buf        Buffer to decompress
+ * @param [in]  comp_buf_len    Length of comp_buf
+ *
+ * @return Length of the header chain or -1 if comp_buf is malformed, does
+ *         not match the next header values or does not fit in chain_buf
+ */
+int decompress_chain(uint8_t *chain_buf, int chain_buf_size, uint8_t *hdr, uint8_t *comp_buf, int comp_buf_len)
+{
+    uint8_t buffer[48+BUFFERSIZE];
+    int next_header = hdr[6] & 0xFF;
+    int chain_index = 0;
+    int i = 0;
+
+    dictionary_buffer_init(buffer, hdr);
+
+    while (i < comp_buf_len) {
+        int eid = extension_id(next_header);
+        int nhc = comp_buf[i] & 0xFF;
+
+        if (eid >= 0) {
+            if (nhc != (NHC_EXT | (eid << 1))) {
+                return -1;
+            }
+        } else if (next_header == NEXT_HEADER_UDP || next_header == NEXT_HEADER_ICMPV6) {
+            if (nhc != (next_header == NEXT_HEADER_UDP ? NHC_UDP : NHC_ICMPV6)) {
+                return -1;
+            }
+        } else {
+            if (chain_index + comp_buf_len - i > chain_buf_size) {
+                return -1;
+            }
+            memcpy(&chain_buf[chain_index], &comp_buf[i], comp_buf_len - i);
+            chain_index += comp_buf_len - i;
+            break;
+        }
+        i++;
+
+        int buffer_index = 48;
+        int stop = decompress_buffer(buffer, sizeof(buffer), &buffer_index, &comp_buf[i], comp_buf_len - i);
+        if (stop < 0 || chain_index + buffer_index - 48 > chain_buf_size) {
+            return -1;
+        }
+        if (eid >= 0 && (stop == comp_buf_len - i || buffer_index == 48)) {
+            /* Extension headers end with a STOP code */
+            return -1;
+        }
+
+        memcpy(&chain_buf[chain_index], &buffer[48], buffer_index - 48);
+        chain_index += buffer_index - 48;
+        i += stop + 1;
+
+        if (eid < 0) {
+            /* UDP or ICMPv6 runs to the end, after a STOP code the rest is not compressed */
+            if (i < comp_buf_len) {
+                if (chain_index + comp_buf_len - i > chain_buf_size) {
+                    return -1;
+                }
+                memcpy(&chain_buf[chain_index], &comp_buf[i], comp_buf_len - i);
+                chain_index += comp_buf_len - i;
+            }
+            break;
+        }
+        next_header = buffer[48] & 0xFF;
+        if (later_fragment(eid, &buffer[48])) {
+            next_header = -1;
+        }
+    }
+    return chain_index;
 }
@@ -27,11 +27,56 @@ typedef __int8_t uint8_t;
 #define SET_BACKREF 0xA0
 #define BACKREF     0xC0
 
+/* NHC dispatch of GHC compressed headers */
+#define NHC_EXT     0xB0
+#define NHC_UDP     0xD0
+#define NHC_ICMPV6  0xDF
+
+#define NEXT_HEADER_HOP_BY_HOP      0
+#define NEXT_HEADER_ROUTING         43
+#define NEXT_HEADER_FRAGMENT        44
+#define NEXT_HEADER_DEST_OPTIONS    60
+#define NEXT_HEADER_MOBILITY        135
+#define NEXT_HEADER_UDP             17
+#define NEXT_HEADER_ICMPV6          58
+
 #define BUFFERSIZE  1000
 #define DEBUG       0
 
+/* One opcode of a compressed payload, as seen from the decompressed side */
+typedef struct {
+    int start;      /* Buffer index (dictionary included) of the first byte produced */
+    int length;     /* Number of bytes produced */
+    int code;       /* COPY, ZERO or BACKREF */
+    int source;     /* COPY: index into comp_buf, BACKREF: distance s */
+} segment_t;
+
+typedef struct {
+    uint8_t dictionary[48];
+    uint8_t *comp_buf;
+    segment_t *segments;
+    int segment_count;
+    int payload_len;
+} inspect_t;
+
+/* Search effort levels of compress_level(), from most to least effort */
+#define LEVEL_FULL      0
+#define LEVEL_BOUNDED   1
+#define LEVEL_ZERO      2
+#define LEVEL_RAW       3
+
+#define BOUNDED_WINDOW  32
+
 void dictionary_buffer_init(uint8_t *comp_buffer, uint8_t* hdr);
 void decompress(uint8_t *decomp_buf, uint8_t *hdr, uint8_t *comp_buf, int comp_buf_length);
-void compress(uint8_t *comp_buf, uint8_t *hdr, uint8_t *payload_buf, int payload_buf_len);
+int compress(uint8_t *comp_buf, uint8_t *hdr, uint8_t *payload_buf, int payload_buf_len);
+int compress_level(uint8_t *comp_buf, uint8_t *hdr, uint8_t *payload_buf, int payload_buf_len, int level);
+int inspect_init(inspect_t *inspect, segment_t *segments, uint8_t *hdr, uint8_t *comp_buf, int comp_buf_len);
+int inspect_range(inspect_t *inspect, uint8_t *range_buf, int offset, int length);
+int inspect_byte(inspect_t *inspect, int offset);
+int decompress_range(uint8_t *range_buf, uint8_t *hdr, uint8_t *comp_buf, int comp_buf_len, int offset, int length);
+int decompress_byte(uint8_t *hdr, uint8_t *comp_buf, int comp_buf_len, int offset);
+int compress_chain(uint8_t *comp_buf, uint8_t *hdr, uint8_t *chain_buf, int chain_buf_len);
+int decompress_chain(uint8_t *chain_buf, int chain_buf_size, uint8_t *hdr, uint8_t *comp_buf, int comp_buf_len);
 
 #endif
@@ -17,10 +17,13 @@
  * @author Christoffer Hamberg
  */
 
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "adaptive.h"
 #include "ghc.h"
+#include "traffic.h"
 
 void compareBuffer(uint8_t *buffer1, uint8_t *buffer2, int buffer_len, int offset)
 {
@@ -44,6 +47,48 @@ void compareDictionary(uint8_t *buffer1, uint8_t *buffer2, int buffer_len)
     printf("Passed\n");
 }
 
+void compareRange(uint8_t *hdr, uint8_t *comp_buf, int comp_buf_len, uint8_t *payload, int payload_len)
+{
+    uint8_t range[BUFFERSIZE];
+    segment_t segments[BUFFERSIZE];
+    inspect_t inspect;
+
+    if (inspect_init(&inspect, segments, hdr, comp_buf, comp_buf_len) != payload_len) {
+        printf("Failed: payload length: %d, Expected: %d\n", inspect.payload_len, payload_len);
+        return;
+    }
+    for (int i = 0; i < payload_len; i++) {
+        int value = inspect_byte(&inspect, i);
+        if (value != (payload[i] & 0xFF)) {
+            printf("Failed: i: %d, Got: %02x, Expected: %02x\n", i, value, payload[i]);
+            return;
+        }
+    }
+    if (inspect_byte(&inspect, payload_len) != -1 ||
+        decompress_byte(hdr, comp_buf, comp_buf_len, payload_len) != -1) {
+        printf("Failed: read past end of payload\n");
+        return;
+    }
+    /* A length reaching past INT_MAX is clamped to the payload */
+    int length = decompress_range(range, hdr, comp_buf, comp_buf_len, payload_len / 3, INT_MAX);
+    if (length != payload_len - payload_len / 3) {
+        printf("Failed: range length: %d, Expected: %d\n", length, payload_len - payload_len / 3);
+        return;
+    }
+    compareBuffer(payload, range, length, payload_len / 3);
+}
+
+/*
+ * Feeds packets of 100 bytes to the adaptive state, each costing the time
+ * and giving the compressed length listed for the current level
+ */
+void feedAdaptive(adaptive_t *state, long *cost_ns, int *cost_len, int count)
+{
+    for (int i = 0; i < count; i++) {
+        adaptive_update(state, 100, cost_len[state->level], cost_ns[state->level]);
+    }
+}
+
 int main(int argc, const char * argv[])
 {
     uint8_t buffer[BUFFERSIZE];
@@ -76,6 +121,8 @@ int main(int argc, const char * argv[])
     decompress(buffer2, hdr0, buffer, sizeof(compressed0));
     printf("Decompress: ");
     compareBuffer(buffer2, payload0, sizeof(payload0), 48);
+    printf("Range: ");
+    compareRange(hdr0, compressed0, sizeof(compressed0), payload0, sizeof(payload0));
     printf("______\n");
     
     uint8_t hdr1[] = {
@@ -114,6 +161,8 @@ int main(int argc, const char * argv[])
     decompress(buffer2, hdr1, buffer, sizeof(compressed1));
     printf("Decompress: ");
     compareBuffer(buffer2, payload1, sizeof(payload1), 48);
+    printf("Range: ");
+    compareRange(hdr1, compressed1, sizeof(compressed1), payload1, sizeof(payload1));
     printf("______\n");
  
     uint8_t hdr2[] = {
@@ -148,6 +197,8 @@ int main(int argc, const char * argv[])
     decompress(buffer2, hdr2, buffer, sizeof(compressed2));
     printf("Decompress: ");
     compareBuffer(buffer2, payload2, sizeof(payload2), 48);
+    printf("Range: ");
+    compareRange(hdr2, compressed2, sizeof(compressed2), payload2, sizeof(payload2));
     printf("______\n");
     
     uint8_t hdr3[] = {
@@ -182,6 +233,8 @@ int main(int argc, const char * argv[])
     decompress(buffer2, hdr3, buffer, sizeof(compressed3));
     printf("Decompress: ");
     compareBuffer(buffer2, payload3, sizeof(payload3), 48);
+    printf("Range: ");
+    compareRange(hdr3, compressed3, sizeof(compressed3), payload3, sizeof(payload3));
     printf("______\n");
     
     uint8_t hdr4[] = {
@@ -216,6 +269,8 @@ int main(int argc, const char * argv[])
     decompress(buffer2, hdr4, buffer, sizeof(compressed4));
     printf("Decompress: ");
     compareBuffer(buffer2, payload4, sizeof(payload4), 48);
+    printf("Range: ");
+    compareRange(hdr4, compressed4, sizeof(compressed4), payload4, sizeof(payload4));
     printf("______\n");
   
     uint8_t hdr5[] = {
@@ -247,6 +302,8 @@ int main(int argc, const char * argv[])
     decompress(buffer2, hdr5, buffer, sizeof(compressed5));
     printf("Decompress: ");
     compareBuffer(buffer2, payload5, sizeof(payload5), 48);
+    printf("Range: ");
+    compareRange(hdr5, compressed5, sizeof(compressed5), payload5, sizeof(payload5));
     printf("______\n");
     
     uint8_t hdr6[] = {
@@ -286,6 +343,8 @@ int main(int argc, const char * argv[])
     decompress(buffer2, hdr6, buffer, sizeof(compressed6));
     printf("Decompress: ");
     compareBuffer(buffer2, payload6, sizeof(payload6), 48);
+    printf("Range: ");
+    compareRange(hdr6, compressed6, sizeof(compressed6), payload6, sizeof(payload6));
     printf("______\n");
     
     uint8_t hdr7[] = {
@@ -319,6 +378,8 @@ int main(int argc, const char * argv[])
     decompress(buffer2, hdr7, buffer, sizeof(compressed7));
     printf("Decompress: ");
     compareBuffer(buffer2, payload7, sizeof(payload7), 48);
+    printf("Range: ");
+    compareRange(hdr7, compressed7, sizeof(compressed7), payload7, sizeof(payload7));
     printf("______\n");
     
     uint8_t hdr8[] = {
@@ -352,6 +413,8 @@ int main(int argc, const char * argv[])
     decompress(buffer2, hdr8, buffer, sizeof(compressed8));
     printf("Decompress: ");
     compareBuffer(buffer2, payload8, sizeof(payload8), 48);
+    printf("Range: ");
+    compareRange(hdr8, compressed8, sizeof(compressed8), payload8, sizeof(payload8));
     printf("______\n");
     
     uint8_t hdr9[] = {
@@ -389,6 +452,299 @@ int main(int argc, const char * argv[])
     decompress(buffer2, hdr9, buffer, sizeof(compressed9));
     printf("Decompress: ");
     compareBuffer(buffer2, payload9, sizeof(payload9), 48);
+    printf("Range: ");
+    compareRange(hdr9, compressed9, sizeof(compressed9), payload9, sizeof(payload9));
+    printf("______\n");
+    
+    printf("Testcase: levels\n");
+    for (int level = LEVEL_FULL; level <= LEVEL_RAW; level++) {
+        int length = compress_level(buffer, hdr8, payload8, sizeof(payload8), level);
+        decompress(buffer2, hdr8, buffer, length);
+        printf("Level %d (%d bytes): ", level, length);
+        compareBuffer(buffer2, payload8, sizeof(payload8), 48);
+        printf("Level %d range: ", level);
+        compareRange(hdr8, buffer, length, payload8, sizeof(payload8));
+    }
+    printf("______\n");
+    
+    printf("Testcase: malformed\n");
+    segment_t segments[BUFFERSIZE];
+    inspect_t inspect;
+    uint8_t copy_past_end[] = { 0x7f, 0x41 };
+    printf("Copy past end: ");
+    if (inspect_init(&inspect, segments, hdr8, copy_past_end, sizeof(copy_past_end)) == -1 &&
+        inspect_byte(&inspect, 0) == -1 &&
+        decompress_byte(hdr8, copy_past_end, sizeof(copy_past_end), 1) == -1) {
+        printf("Passed\n");
+    } else {
+        printf("Failed\n");
+    }
+    /* SET_BACKREF 0xaf moves the source 120 bytes back, before the dictionary */
+    uint8_t backref_before_start[] = { 0xaf, 0xc0 };
+    printf("Backref before start: ");
+    if (inspect_init(&inspect, segments, hdr8, backref_before_start, sizeof(backref_before_start)) == -1 &&
+        decompress_range(buffer, hdr8, backref_before_start, sizeof(backref_before_start), 0, 10) == 0) {
+        printf("Passed\n");
+    } else {
+        printf("Failed\n");
+    }
+    printf("Empty: ");
+    if (decompress_range(buffer, hdr8, copy_past_end, 0, 0, 10) == 0 &&
+        decompress_byte(hdr8, copy_past_end, -1, 0) == -1) {
+        printf("Passed\n");
+    } else {
+        printf("Failed\n");
+    }
+    printf("______\n");
+    
+    printf("Testcase: adaptive\n");
+    long cost_ns[] = { 4000, 2000, 1000, 300 };
+    long probe_ns[] = { 4000, 1000, 500, 100 };
+    int cost_len[] = { 40, 50, 60, 101 };
+    adaptive_t state;
+    adaptive_init(&state, 1000000000L);
+    feedAdaptive(&state, cost_ns, cost_len, 100);
+    printf("Unlimited budget: ");
+    if (state.level == LEVEL_FULL && state.changes == 0 && adaptive_ratio_lost(&state) == 0) {
+        printf("Passed\n");
+    } else {
+        printf("Failed: level: %d, changes: %ld\n", state.level, state.changes);
+    }
+    
+    /* 101 packets at LEVEL_FULL, 8 at LEVEL_BOUNDED and LEVEL_ZERO, 75 at LEVEL_RAW */
+    state.target_ns = 500;
+    feedAdaptive(&state, cost_ns, cost_len, 92);
+    double lost = adaptive_ratio_lost(&state);
+    printf("Over budget: ");
+    if (state.level == LEVEL_RAW && state.changes == 3 && lost > 0.2507 && lost < 0.2509) {
+        printf("Passed\n");
+    } else {
+        printf("Failed: level: %d, changes: %ld, lost: %f\n", state.level, state.changes, lost);
+    }
+    
+    /* Every level is probed again once the budget allows it */
+    state.target_ns = 1000000000L;
+    feedAdaptive(&state, cost_ns, cost_len, 500);
+    printf("Step up: ");
+    if (state.level == LEVEL_FULL && state.changes == 6) {
+        printf("Passed\n");
+    } else {
+        printf("Failed: level: %d, changes: %ld\n", state.level, state.changes);
+    }
+    
+    /* One preempted packet does not push the average over the budget */
+    adaptive_init(&state, 5000);
+    feedAdaptive(&state, cost_ns, cost_len, 50);
+    adaptive_update(&state, 100, cost_len[LEVEL_FULL], 1000000L);
+    feedAdaptive(&state, cost_ns, cost_len, 50);
+    printf("Single spike: ");
+    if (state.level == LEVEL_FULL && state.changes == 0) {
+        printf("Passed\n");
+    } else {
+        printf("Failed: level: %d, changes: %ld\n", state.level, state.changes);
+    }
+    
+    /* A budget between two levels settles at the cheaper one */
+    adaptive_init(&state, 2500);
+    feedAdaptive(&state, cost_ns, cost_len, 20000);
+    printf("Intermediate budget: ");
+    if (state.level == LEVEL_BOUNDED && state.changes == 1) {
+        printf("Passed\n");
+    } else {
+        printf("Failed: level: %d, changes: %ld\n", state.level, state.changes);
+    }
+    
+    /* Failing probes of LEVEL_FULL back off instead of bouncing every few packets */
+    adaptive_init(&state, 3000);
+    feedAdaptive(&state, probe_ns, cost_len, 20000);
+    printf("Probe backoff: ");
+    if (state.backoff == ADAPTIVE_BACKOFF && state.changes < 40) {
+        printf("Passed\n");
+    } else {
+        printf("Failed: backoff: %d, changes: %ld\n", state.backoff, state.changes);
+    }
+    
+    /* Only ADAPTIVE_SAMPLES packets at LEVEL_FULL before the first step down */
+    adaptive_init(&state, 0);
+    feedAdaptive(&state, cost_ns, cost_len, 100);
+    printf("Too few reference packets: ");
+    if (adaptive_ratio_lost(&state) == -1) {
+        printf("Passed\n");
+    } else {
+        printf("Failed: %f\n", adaptive_ratio_lost(&state));
+    }
+    
+    adaptive_init(&state, 0);
+    for (int i = 0; i < 50; i++) {
+        int length = compress_adaptive(&state, buffer, hdr9, payload9, sizeof(payload9));
+        decompress(buffer2, hdr9, buffer, length);
+    }
+    printf("Compress adaptive (level %d): ", state.level);
+    compareBuffer(buffer2, payload9, sizeof(payload9), 48);
+    printf("______\n");
+    
+    printf("Testcase: traffic\n");
+    traffic_config_t config;
+    traffic_t traffic, replay;
+    uint8_t hdr[40], hdr_replay[40];
+    uint8_t payload_replay[BUFFERSIZE];
+    traffic_default_config(&config, 2013);
+    config.max_payload = TRAFFIC_MAX_PAYLOAD;
+    traffic_init(&traffic, &config);
+    traffic_init(&replay, &config);
+    
+    int reproducible = 1, round_trip = 1;
+    for (int i = 0; i < 5000; i++) {
+        int payload_len = traffic_next(&traffic, hdr, buffer2);
+        int replay_len = traffic_next(&replay, hdr_replay, payload_replay);
+        if (payload_len != replay_len || memcmp(hdr, hdr_replay, sizeof(hdr)) != 0 ||
+            memcmp(buffer2, payload_replay, payload_len) != 0) {
+            reproducible = 0;
+        }
+        
+        int length = compress(buffer, hdr, payload_replay, payload_len);
+        decompress(buffer2, hdr, buffer, length);
+        if (memcmp(&buffer2[48], payload_replay, payload_len) != 0) {
+            round_trip = 0;
+        }
+    }
+    traffic_free(&traffic);
+    traffic_free(&replay);
+    printf("Reproducible: %s\n", reproducible ? "Passed" : "Failed");
+    printf("Round trip: %s\n", round_trip ? "Passed" : "Failed");
+    printf("______\n");
+    
+    uint8_t hdr_chain[] = {
+        0x60, 0x00, 0x00, 0x00, 0x00, 0x2d, 0x00, 0x40, 0x20, 0x01, 0x0d, 0xb8, 0x00, 0x00, 0x00, 0x00,
+        0x02, 0x1c, 0xda, 0xff, 0xfe, 0x00, 0x00, 0x00, 0x20, 0x01, 0x0d, 0xb8, 0x00, 0x00, 0x00, 0x00,
+        0x02, 0x1c, 0xda, 0xff, 0xfe, 0x00, 0x00, 0x05 };
+    
+    /* Hop-by-hop RPL option, RPL source route, UDP with a CoAP GET */
+    uint8_t chain[] = {
+        0x2b, 0x00, 0x63, 0x04, 0x00, 0x1e, 0x02, 0x00, 0x11, 0x01, 0x03, 0x01, 0xee, 0x40, 0x00, 0x00,
+        0x00, 0x03, 0x00, 0x05, 0x00, 0x00, 0x00, 0x00, 0xf0, 0xb1, 0x16, 0x33, 0x00, 0x15, 0x4b, 0x7e,
+        0x41, 0x01, 0x12, 0x34, 0xab, 0xb7, 0x73, 0x65, 0x6e, 0x73, 0x6f, 0x72, 0x73 };
+    
+    uint8_t chain_nhc[] = { 0xb0, 0xb2, 0xd0 };
+    
+    printf("Testcase: chain\n");
+    int chain_len = compress_chain(buffer, hdr_chain, chain, sizeof(chain));
+    
+    /* Every header compressed on its own, behind its NHC byte and followed by STOP */
+    int boundaries = 1;
+    int element_start = 0, comp_index = 0;
+    for (int k = 0; k < 3; k++) {
+        int element_len = k < 2 ? (chain[element_start + 1] + 1) * 8 : sizeof(chain) - element_start;
+        int length = compress(payload_replay, hdr_chain, &chain[element_start], element_len);
+        if (buffer[comp_index] != chain_nhc[k] || memcmp(&buffer[comp_index + 1], payload_replay, length) != 0 ||
+            (k < 2 && (buffer[comp_index + 1 + length] & 0xFF) != STOP)) {
+            boundaries = 0;
+        }
+        comp_index += 1 + length + (k < 2);
+        element_start += element_len;
+    }
+    printf("NHC (%d bytes): %s\n", chain_len, boundaries && comp_index == chain_len ? "Passed" : "Failed");
+    
+    printf("Decompress chain: ");
+    if (decompress_chain(buffer2, sizeof(buffer2), hdr_chain, buffer, chain_len) == sizeof(chain)) {
+        compareBuffer(buffer2, chain, sizeof(chain), 0);
+    } else {
+        printf("Failed: length\n");
+    }
+    
+    /* TCP after the hop-by-hop header is carried inline */
+    chain[0] = 0x06;
+    chain_len = compress_chain(buffer, hdr_chain, chain, sizeof(chain));
+    printf("Inline (%d bytes): ", chain_len);
+    if (decompress_chain(buffer2, sizeof(buffer2), hdr_chain, buffer, chain_len) == sizeof(chain)) {
+        compareBuffer(buffer2, chain, sizeof(chain), 0);
+    } else {
+        printf("Failed: length\n");
+    }
+    
+    traffic_init(&traffic, &config);
+    round_trip = 1;
+    for (int i = 0; i < 1000; i++) {
+        int payload_len = traffic_next(&traffic, hdr, payload_replay);
+        chain_len = compress_chain(buffer, hdr, payload_replay, payload_len);
+        int length = compress(buffer2, hdr, payload_replay, payload_len);
+        if (chain_len != length + 1 || memcmp(&buffer[1], buffer2, length) != 0 ||
+            decompress_chain(buffer2, sizeof(buffer2), hdr, buffer, chain_len) != payload_len ||
+            memcmp(buffer2, payload_replay, payload_len) != 0) {
+            round_trip = 0;
+        }
+    }
+    traffic_free(&traffic);
+    printf("Traffic round trip: %s\n", round_trip ? "Passed" : "Failed");
+    
+    /* UDP source port 53, STOP and uncompressed data after the UDP header */
+    uint8_t udp_stop[] = { NHC_UDP, 0x08, 0x00, 0x35, 0x16, 0x33, 0x00, 0x0a, 0x00, 0x00, STOP, 0x41, 0x01 };
+    uint8_t udp_plain[] = { 0x00, 0x35, 0x16, 0x33, 0x00, 0x0a, 0x00, 0x00, 0x41, 0x01 };
+    hdr_chain[6] = NEXT_HEADER_UDP;
+    printf("Low source port: ");
+    if (decompress_chain(buffer2, sizeof(buffer2), hdr_chain, udp_stop, sizeof(udp_stop)) == sizeof(udp_plain)) {
+        compareBuffer(buffer2, udp_plain, sizeof(udp_plain), 0);
+    } else {
+        printf("Failed: length\n");
+    }
+    
+    /* A LEVEL_RAW body starts with STOP */
+    buffer[0] = NHC_UDP;
+    chain_len = 1 + compress_level(&buffer[1], hdr_chain, udp_plain, sizeof(udp_plain), LEVEL_RAW);
+    printf("Raw body: ");
+    if (decompress_chain(buffer2, sizeof(buffer2), hdr_chain, buffer, chain_len) == sizeof(udp_plain)) {
+        compareBuffer(buffer2, udp_plain, sizeof(udp_plain), 0);
+    } else {
+        printf("Failed: length\n");
+    }
+    
+    /* 99 ZERO codes of 17 bytes each overflow the decompression buffer */
+    buffer[0] = NHC_UDP;
+    memset(&buffer[1], 0x8f, 99);
+    printf("Oversized: ");
+    if (decompress_chain(buffer2, sizeof(buffer2), hdr_chain, buffer, 100) == -1) {
+        printf("Passed\n");
+    } else {
+        printf("Failed\n");
+    }
+    
+    uint8_t udp_backref[] = { NHC_UDP, 0xaf, 0xaf, 0xc0 };
+    printf("Backref before start: ");
+    if (decompress_chain(buffer2, sizeof(buffer2), hdr_chain, udp_backref, sizeof(udp_backref)) == -1) {
+        printf("Passed\n");
+    } else {
+        printf("Failed\n");
+    }
+    
+    printf("Small chain buffer: ");
+    if (decompress_chain(buffer2, sizeof(udp_plain) - 1, hdr_chain, udp_stop, sizeof(udp_stop)) == -1) {
+        printf("Passed\n");
+    } else {
+        printf("Failed\n");
+    }
+    
+    /* Only the first fragment starts with the UDP header, later ones are carried inline */
+    uint8_t fragment[] = {
+        0x11, 0x00, 0x00, 0x01, 0x00, 0x00, 0x12, 0x34, 0x16, 0x33, 0x16, 0x33, 0x00, 0x20, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
+    hdr_chain[6] = NEXT_HEADER_FRAGMENT;
+    for (int offset = 0; offset < 2; offset++) {
+        fragment[3] = offset ? 0x08 : 0x01;
+        chain_len = compress_chain(buffer, hdr_chain, fragment, sizeof(fragment));
+        int stop = 1;
+        while ((buffer[stop] & 0xFF) != STOP) {
+            stop++;
+        }
+        printf("Fragment offset %d (%d bytes): ", offset * 8, chain_len);
+        if (offset ? memcmp(&buffer[stop + 1], &fragment[8], sizeof(fragment) - 8) != 0
+                   : (buffer[stop + 1] & 0xFF) != NHC_UDP) {
+            printf("Failed: after the fragment header\n");
+        } else if (decompress_chain(buffer2, sizeof(buffer2), hdr_chain, buffer, chain_len) == sizeof(fragment)) {
+            compareBuffer(buffer2, fragment, sizeof(fragment), 0);
+        } else {
+            printf("Failed: length\n");
+        }
+    }
     printf("______\n");
     
     return 0;
@@ -0,0 +1,614 @@
+/*
+ * Copyright (C) 2026 GHC contributors
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * Synthetic 6LoWPAN traffic generator
+ *
+ * Every packet belongs to a flow (source node and packet kind). A flow keeps
+ * its seed, so packets continuing a flow only differ in sequence numbers,
+ * measurements and ciphertext like real traffic does.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "traffic.h"
+
+#define PORT_COAP           5683
+#define PORT_DTLS           5684
+
+static const char *uri_paths[][2] = {
+    { "sensors", "temp" },
+    { "sensors", "humidity" },
+    { "actuators", "leds" },
+    { ".well-known", "core" },
+    { "rd", NULL }
+};
+
+/*
+ * xorshift64* pseudo random number generator
+ */
+static unsigned long long next_random(unsigned long long *state)
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1DULL;
+}
+
+static unsigned int random_below(unsigned long long *state, unsigned int bound)
+{
+    return (unsigned int)(next_random(state) >> 32) % bound;
+}
+
+static void random_seed(unsigned long long *state, unsigned long long seed)
+{
+    *state = seed ^ 0x9E3779B97F4A7C15ULL;
+    if (*state == 0) {
+        *state = 1;
+    }
+}
+
+/*
+ * Link-local (fe80::/64) or global (2001:db8::/64) address of a node,
+ * node 0 is the RPL root and 6LoWPAN border router
+ */
+static void node_address(uint8_t *address, int node, int global)
+{
+    const uint8_t link_local[] = { 0xfe, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
+    const uint8_t global_prefix[] = { 0x20, 0x01, 0x0d, 0xb8, 0x00, 0x00, 0x00, 0x00 };
+    const uint8_t iid[] = { 0x02, 0x1c, 0xda, 0xff, 0xfe, 0x00 };
+
+    memcpy(&address[0], global ? global_prefix : link_local, 8);
+    memcpy(&address[8], iid, 6);
+    address[14] = (node >> 8) & 0xFF;
+    address[15] = node & 0xFF;
+}
+
+/* EUI-64 of a node, the interface identifier with the U/L bit flipped */
+static void node_eui64(uint8_t *eui64, int node)
+{
+    uint8_t address[16];
+
+    node_address(address, node, 0);
+    memcpy(eui64, &address[8], 8);
+    eui64[0] ^= 0x02;
+}
+
+static void put_16(uint8_t *buf, unsigned int value)
+{
+    buf[0] = (value >> 8) & 0xFF;
+    buf[1] = value & 0xFF;
+}
+
+/*
+ * ICMPv6 and UDP checksum over the IPv6 pseudo header
+ */
+static void set_checksum(uint8_t *hdr, uint8_t *payload_buf, int payload_len, int checksum_index)
+{
+    unsigned long sum = 0;
+
+    for (int i = 8; i < 40; i += 2) {
+        sum += ((hdr[i] & 0xFF) << 8) + (hdr[i+1] & 0xFF);
+    }
+    sum += payload_len + (hdr[6] & 0xFF);
+
+    put_16(&payload_buf[checksum_index], 0);
+    for (int i = 0; i < payload_len; i += 2) {
+        sum += (payload_buf[i] & 0xFF) << 8;
+        if (i + 1 < payload_len) {
+            sum += payload_buf[i+1] & 0xFF;
+        }
+    }
+    while (sum >> 16) {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+    put_16(&payload_buf[checksum_index], ~sum & 0xFFFF);
+}
+
+static void ipv6_header(uint8_t *hdr, uint8_t *src, uint8_t *dst, int next_header, int hop_limit)
+{
+    memset(hdr, 0x00, 8);
+    hdr[0] = 0x60;
+    hdr[6] = next_header;
+    hdr[7] = hop_limit;
+    memcpy(&hdr[8], src, 16);
+    memcpy(&hdr[24], dst, 16);
+}
+
+/* Sets the payload length and, if checksum_index >= 0, the checksum */
+static int finish_packet(uint8_t *hdr, uint8_t *payload_buf, int payload_len, int checksum_index)
+{
+    put_16(&hdr[4], payload_len);
+    if (checksum_index >= 0) {
+        set_checksum(hdr, payload_buf, payload_len, checksum_index);
+    }
+    return payload_len;
+}
+
+static int udp_header(uint8_t *payload_buf, unsigned int src_port, unsigned int dst_port)
+{
+    put_16(&payload_buf[0], src_port);
+    put_16(&payload_buf[2], dst_port);
+    return 8;
+}
+
+static int random_payload_len(traffic_config_t *config, unsigned long long *packet)
+{
+    return config->min_payload + random_below(packet, config->max_payload - config->min_payload + 1);
+}
+
+/*
+ * RPL DODAG Information Object, sent to all RPL nodes
+ */
+static int rpl_dio(uint8_t *hdr, uint8_t *payload_buf, int node, traffic_flow_t *flow, unsigned long long *content)
+{
+    uint8_t src[16], dst[16] = { 0xff, 0x02 };
+    int i = 0;
+
+    dst[15] = 0x1a;
+    node_address(src, node, 0);
+    ipv6_header(hdr, src, dst, NEXT_HEADER_ICMPV6, 255);
+
+    payload_buf[i++] = 0x9b;
+    payload_buf[i++] = 0x01;
+    i += 2;
+    payload_buf[i++] = 0x1e + random_below(content, 2);         /* RPLInstanceID */
+    payload_buf[i++] = 0xf0 + (flow->sequence >> 4);            /* Version */
+    put_16(&payload_buf[i], 256 * (node == 0 ? 1 : 2 + random_below(content, 6)));
+    i += 2;
+    payload_buf[i++] = 0x88;                                    /* G, MOP non-storing */
+    payload_buf[i++] = flow->sequence;                          /* DTSN */
+    payload_buf[i++] = 0x00;
+    payload_buf[i++] = 0x00;
+    node_address(&payload_buf[i], 0, 1);                        /* DODAGID */
+    i += 16;
+
+    /* DODAG Configuration option */
+    const uint8_t dodag_config[] = {
+        0x04, 0x0e, 0x00, 0x08, 0x0c, 0x0a, 0x07, 0x00, 0x01, 0x00, 0x00, 0x01, 0x00, 0x1e, 0x00, 0x3c };
+    memcpy(&payload_buf[i], dodag_config, sizeof(dodag_config));
+    i += sizeof(dodag_config);
+
+    if (random_below(content, 2)) {
+        /* Prefix Information option */
+        const uint8_t prefix_info[] = {
+            0x08, 0x1e, 0x40, 0x60, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x00, 0x00, 0x00, 0x00 };
+        memcpy(&payload_buf[i], prefix_info, sizeof(prefix_info));
+        i += sizeof(prefix_info);
+        node_address(&payload_buf[i], 0, 1);
+        memset(&payload_buf[i+8], 0x00, 8);
+        i += 16;
+    }
+    return finish_packet(hdr, payload_buf, i, 2);
+}
+
+/*
+ * RPL Destination Advertisement Object in non-storing mode, sent to the root
+ */
+static int rpl_dao(uint8_t *hdr, uint8_t *payload_buf, int node, traffic_flow_t *flow, unsigned long long *content)
+{
+    uint8_t src[16], dst[16];
+    int i = 0;
+
+    node_address(src, node, 1);
+    node_address(dst, 0, 1);
+    ipv6_header(hdr, src, dst, NEXT_HEADER_ICMPV6, 64);
+
+    payload_buf[i++] = 0x9b;
+    payload_buf[i++] = 0x02;
+    i += 2;
+    payload_buf[i++] = 0x1e;
+    payload_buf[i++] = 0x40;                                    /* K */
+    payload_buf[i++] = 0x00;
+    payload_buf[i++] = flow->sequence;                          /* DAOSequence */
+
+    /* RPL Target option */
+    payload_buf[i++] = 0x05;
+    payload_buf[i++] = 0x12;
+    payload_buf[i++] = 0x00;
+    payload_buf[i++] = 0x80;
+    node_address(&payload_buf[i], node, 1);
+    i += 16;
+
+    /* Transit Information option with parent address */
+    payload_buf[i++] = 0x06;
+    payload_buf[i++] = 0x14;
+    payload_buf[i++] = 0x00;
+    payload_buf[i++] = 0x00;
+    payload_buf[i++] = flow->sequence;                          /* Path Sequence */
+    payload_buf[i++] = 0x1e;                                    /* Path Lifetime */
+    node_address(&payload_buf[i], random_below(content, node), 1);
+    i += 16;
+
+    return finish_packet(hdr, payload_buf, i, 2);
+}
+
+/* Address Registration option (RFC 6775) */
+static int aro_option(uint8_t *payload_buf, int node, int status)
+{
+    payload_buf[0] = 0x21;
+    payload_buf[1] = 0x02;
+    payload_buf[2] = status;
+    memset(&payload_buf[3], 0x00, 3);
+    put_16(&payload_buf[6], 0x0e10);
+    node_eui64(&payload_buf[8], node);
+    return 16;
+}
+
+/*
+ * Neighbor Solicitation registering the global address at the router
+ */
+static int nd_ns(uint8_t *hdr, uint8_t *payload_buf, int node)
+{
+    uint8_t src[16], dst[16];
+    int i = 0;
+
+    node_address(src, node, 0);
+    node_address(dst, 0, 0);
+    ipv6_header(hdr, src, dst, NEXT_HEADER_ICMPV6, 255);
+
+    payload_buf[i++] = 0x87;
+    payload_buf[i++] = 0x00;
+    i += 2;
+    memset(&payload_buf[i], 0x00, 4);
+    i += 4;
+    node_address(&payload_buf[i], node, 1);                     /* Target */
+    i += 16;
+
+    /* Source Link-Layer Address option */
+    payload_buf[i++] = 0x01;
+    payload_buf[i++] = 0x02;
+    node_eui64(&payload_buf[i], node);
+    memset(&payload_buf[i+8], 0x00, 6);
+    i += 14;
+
+    i += aro_option(&payload_buf[i], node, 0);
+    return finish_packet(hdr, payload_buf, i, 2);
+}
+
+/*
+ * Neighbor Advertisement of the router confirming a registration
+ */
+static int nd_na(uint8_t *hdr, uint8_t *payload_buf, int node, unsigned long long *content)
+{
+    uint8_t src[16], dst[16];
+    int i = 0;
+
+    node_address(src, 0, 0);
+    node_address(dst, node, 0);
+    ipv6_header(hdr, src, dst, NEXT_HEADER_ICMPV6, 255);
+
+    payload_buf[i++] = 0x88;
+    payload_buf[i++] = 0x00;
+    i += 2;
+    payload_buf[i++] = 0xc0;                                    /* R, S */
+    memset(&payload_buf[i], 0x00, 3);
+    i += 3;
+    node_address(&payload_buf[i], node, 1);
+    i += 16;
+
+    /* Mostly successful registrations, sometimes a full neighbor cache */
+    i += aro_option(&payload_buf[i], node, random_below(content, 16) == 0 ? 2 : 0);
+    return finish_packet(hdr, payload_buf, i, 2);
+}
+
+static int coap_option(uint8_t *payload_buf, int delta, const char *value, int value_len)
+{
+    payload_buf[0] = (delta << 4) | value_len;
+    memcpy(&payload_buf[1], value, value_len);
+    return value_len + 1;
+}
+
+/*
+ * CoAP GET request from a client to a server node, optionally registering
+ * as an observer
+ */
+static int coap_get(uint8_t *hdr, uint8_t *payload_buf, int node, int server, traffic_flow_t *flow, unsigned long long *content)
+{
+    uint8_t src[16], dst[16];
+    int token_len = random_below(content, 5);
+    int observe = random_below(content, 2);
+    const char **path = uri_paths[random_below(content, sizeof(uri_paths) / sizeof(uri_paths[0]))];
+    int i = 0;
+
+    node_address(src, node, 1);
+    node_address(dst, server, 1);
+    ipv6_header(hdr, src, dst, NEXT_HEADER_UDP, 64);
+    i += udp_header(payload_buf, 0xf0b0 + random_below(content, 16), PORT_COAP);
+
+    payload_buf[i++] = 0x40 | token_len;                        /* CON */
+    payload_buf[i++] = 0x01;                                    /* GET */
+    put_16(&payload_buf[i], flow->sequence);
+    i += 2;
+    for (int t = 0; t < token_len; t++) {
+        payload_buf[i++] = random_below(content, 256);
+    }
+
+    int option = 0;
+    if (observe) {
+        payload_buf[i++] = 0x60;                                /* Observe: 0 */
+        option = 6;
+    }
+    for (int p = 0; p < 2 && path[p] != NULL; p++) {
+        i += coap_option(&payload_buf[i], 11 - option, path[p], strlen(path[p]));
+        option = 11;
+    }
+
+    put_16(&payload_buf[4], i);
+    return finish_packet(hdr, payload_buf, i, 6);
+}
+
+/*
+ * Non-confirmable CoAP notification from a server to an observer
+ */
+static int coap_observe(uint8_t *hdr, uint8_t *payload_buf, int node, int client, traffic_config_t *config,
+                        traffic_flow_t *flow, unsigned long long *content, unsigned long long *packet)
+{
+    uint8_t src[16], dst[16];
+    int token_len = 1 + random_below(content, 4);
+    int i = 0;
+
+    node_address(src, node, 1);
+    node_address(dst, client, 1);
+    ipv6_header(hdr, src, dst, NEXT_HEADER_UDP, 64);
+    i += udp_header(payload_buf, PORT_COAP, 0xf0b0 + random_below(content, 16));
+
+    payload_buf[i++] = 0x50 | token_len;                        /* NON */
+    payload_buf[i++] = 0x45;                                    /* 2.05 Content */
+    put_16(&payload_buf[i], flow->sequence);
+    i += 2;
+    for (int t = 0; t < token_len; t++) {
+        payload_buf[i++] = random_below(content, 256);
+    }
+
+    /* Observe sequence number, Content-Format text/plain, Max-Age */
+    payload_buf[i++] = 0x62;
+    put_16(&payload_buf[i], flow->sequence);
+    i += 2;
+    payload_buf[i++] = 0x60;
+    payload_buf[i++] = 0x21;
+    payload_buf[i++] = 0x3c;
+
+    /* Measurements as text, changing every notification */
+    int value_len = random_payload_len(config, packet);
+    if (value_len > 0) {
+        payload_buf[i++] = 0xff;
+        for (int v = 0; v < value_len; v++) {
+            payload_buf[i++] = (v % 5 == 4) ? ';' : '0' + random_below(packet, 10);
+        }
+    }
+
+    put_16(&payload_buf[4], i);
+    return finish_packet(hdr, payload_buf, i, 6);
+}
+
+static int dtls_record_header(uint8_t *payload_buf, int content_type, int epoch, unsigned int sequence)
+{
+    payload_buf[0] = content_type;
+    payload_buf[1] = 0xfe;
+    payload_buf[2] = 0xfd;
+    put_16(&payload_buf[3], epoch);
+    memset(&payload_buf[5], 0x00, 2);
+    put_16(&payload_buf[7], sequence >> 16);
+    put_16(&payload_buf[9], sequence);
+    return 13;
+}
+
+/*
+ * DTLS ClientHello, with the cookie of a HelloVerifyRequest every second time
+ */
+static int dtls_handshake(uint8_t *hdr, uint8_t *payload_buf, int node, int server, traffic_flow_t *flow,
+                          unsigned long long *content, unsigned long long *packet)
+{
+    uint8_t src[16], dst[16];
+    int cookie_len = (flow->sequence & 1) ? 16 : 0;
+    int i = 0;
+
+    node_address(src, node, 1);
+    node_address(dst, server, 1);
+    ipv6_header(hdr, src, dst, NEXT_HEADER_UDP, 64);
+    i += udp_header(payload_buf, 0xf0b0 + random_below(content, 16), PORT_DTLS);
+
+    int record = i;
+    i += dtls_record_header(&payload_buf[i], 0x16, 0, flow->sequence & 1);
+
+    int body_len = 2 + 32 + 1 + 1 + cookie_len + 2 + 4 + 2;
+    payload_buf[i++] = 0x01;                                    /* ClientHello */
+    payload_buf[i++] = 0x00;
+    put_16(&payload_buf[i], body_len);
+    i += 2;
+    put_16(&payload_buf[i], flow->sequence & 1);                /* message_seq */
+    i += 2;
+    memset(&payload_buf[i], 0x00, 4);                           /* fragment_offset, length */
+    i += 4;
+    put_16(&payload_buf[i], body_len);
+    i += 2;
+
+    payload_buf[i++] = 0xfe;
+    payload_buf[i++] = 0xfd;
+    for (int r = 0; r < 32; r++) {
+        payload_buf[i++] = random_below(packet, 256);
+    }
+    payload_buf[i++] = 0x00;                                    /* session_id */
+    payload_buf[i++] = cookie_len;
+    for (int c = 0; c < cookie_len; c++) {
+        payload_buf[i++] = random_below(content, 256);
+    }
+    const uint8_t suites[] = { 0x00, 0x04, 0xc0, 0xa8, 0xc0, 0xae, 0x01, 0x00 };
+    memcpy(&payload_buf[i], suites, sizeof(suites));
+    i += sizeof(suites);
+
+    put_16(&payload_buf[record + 11], i - record - 13);
+    put_16(&payload_buf[4], i);
+    return finish_packet(hdr, payload_buf, i, 6);
+}
+
+/*
+ * DTLS application data record with AES-CCM-8 explicit nonce and tag
+ */
+static int dtls_app(uint8_t *hdr, uint8_t *payload_buf, int node, int server, traffic_config_t *config,
+                    traffic_flow_t *flow, unsigned long long *content, unsigned long long *packet)
+{
+    uint8_t src[16], dst[16];
+    int data_len = random_payload_len(config, packet);
+    int i = 0;
+
+    node_address(src, node, 1);
+    node_address(dst, server, 1);
+    ipv6_header(hdr, src, dst, NEXT_HEADER_UDP, 64);
+    i += udp_header(payload_buf, 0xf0b0 + random_below(content, 16), PORT_DTLS);
+
+    i += dtls_record_header(&payload_buf[i], 0x17, 1, flow->sequence);
+    put_16(&payload_buf[i - 2], 8 + data_len + 8);
+
+    /* The explicit nonce repeats epoch and sequence number */
+    memcpy(&payload_buf[i], &payload_buf[i - 10], 8);
+    i += 8;
+    for (int d = 0; d < data_len + 8; d++) {
+        payload_buf[i++] = random_below(packet, 256);
+    }
+
+    put_16(&payload_buf[4], i);
+    return finish_packet(hdr, payload_buf, i, 6);
+}
+
+/*
+ * Fills in the default configuration: a mix of all packet kinds, up to 64
+ * bytes of application data, 32 nodes and 75% of the packets continuing a
+ * flow
+ *
+ * @param [out] config  Configuration to fill in
+ * @param [in]  seed    Seed of the generated stream
+ *
+ */
+void traffic_default_config(traffic_config_t *config, unsigned long seed)
+{
+    const int mix[TRAFFIC_KINDS] = { 2, 2, 1, 1, 4, 4, 1, 4 };
+
+    config->seed = seed;
+    memcpy(config->mix, mix, sizeof(mix));
+    config->min_payload = 0;
+    config->max_payload = 64;
+    config->nodes = 32;
+    config->repeat = 75;
+}
+
+/*
+ * Initiates a generator
+ *
+ * @param [out] traffic  Generator to initiate
+ * @param [in]  config   Configuration, copied into the generator
+ *
+ * @return 0 on success, -1 on an invalid configuration or allocation failure
+ */
+int traffic_init(traffic_t *traffic, traffic_config_t *config)
+{
+    memset(traffic, 0, sizeof(*traffic));
+
+    if (config->nodes < 2 || config->nodes > 0xFFFF ||
+        config->min_payload < 0 || config->max_payload > TRAFFIC_MAX_PAYLOAD ||
+        config->min_payload > config->max_payload) {
+        return -1;
+    }
+    for (int kind = 0; kind < TRAFFIC_KINDS; kind++) {
+        if (config->mix[kind] < 0) {
+            return -1;
+        }
+        traffic->mix_total += config->mix[kind];
+    }
+    if (traffic->mix_total == 0) {
+        return -1;
+    }
+
+    traffic->flows = calloc(config->nodes * TRAFFIC_KINDS, sizeof(traffic_flow_t));
+    if (traffic->flows == NULL) {
+        return -1;
+    }
+    traffic->config = *config;
+    random_seed(&traffic->state, config->seed);
+    return 0;
+}
+
+/*
+ * Frees the flow table of a generator
+ *
+ * @param [in] traffic  Generator to free
+ *
+ */
+void traffic_free(traffic_t *traffic)
+{
+    free(traffic->flows);
+    traffic->flows = NULL;
+}
+
+/*
+ * Generates the next packet
+ *
+ * @param [in,out] traffic      Generator
+ * @param [out]    hdr          40-byte IPv6 header
+ * @param [out]    payload_buf  Buffer for the payload, at least BUFFERSIZE bytes
+ *
+ * @return Length of the payload
+ */
+int traffic_next(traffic_t *traffic, uint8_t *hdr, uint8_t *payload_buf)
+{
+    traffic_config_t *config = &traffic->config;
+    unsigned long long content, packet;
+
+    /* Pick kind and source node */
+    int pick = random_below(&traffic->state, traffic->mix_total);
+    int kind = 0;
+    while (pick >= config->mix[kind]) {
+        pick -= config->mix[kind];
+        kind++;
+    }
+    int node = random_below(&traffic->state, config->nodes);
+    if (kind == TRAFFIC_RPL_DAO || kind == TRAFFIC_NS || kind == TRAFFIC_NA) {
+        /* The root neither registers nor advertises routes to itself */
+        node = 1 + random_below(&traffic->state, config->nodes - 1);
+    }
+
+    /* Continue the flow or start a new one */
+    traffic_flow_t *flow = &traffic->flows[node * TRAFFIC_KINDS + kind];
+    if (flow->seed != 0 && (int)random_below(&traffic->state, 100) < config->repeat) {
+        flow->sequence++;
+    } else {
+        flow->seed = next_random(&traffic->state) | 1;
+        flow->sequence = random_below(&traffic->state, 0x10000);
+    }
+
+    /* Content is fixed per flow, packet randomness changes every packet */
+    random_seed(&content, flow->seed);
+    random_seed(&packet, next_random(&traffic->state));
+    int peer = random_below(&content, config->nodes - 1);
+    if (peer >= node) {
+        peer++;
+    }
+
+    traffic->kind = kind;
+    switch (kind) {
+        case TRAFFIC_RPL_DIO:
+            return rpl_dio(hdr, payload_buf, node, flow, &content);
+        case TRAFFIC_RPL_DAO:
+            return rpl_dao(hdr, payload_buf, node, flow, &content);
+        case TRAFFIC_NS:
+            return nd_ns(hdr, payload_buf, node);
+        case TRAFFIC_NA:
+            return nd_na(hdr, payload_buf, node, &packet);
+        case TRAFFIC_COAP_GET:
+            return coap_get(hdr, payload_buf, node, peer, flow, &content);
+        case TRAFFIC_COAP_OBSERVE:
+            return coap_observe(hdr, payload_buf, node, peer, config, flow, &content, &packet);
+        case TRAFFIC_DTLS_HANDSHAKE:
+            return dtls_handshake(hdr, payload_buf, node, peer, flow, &content, &packet);
+        default:
+            return dtls_app(hdr, payload_buf, node, peer, config, flow, &content, &packet);
+    }
+}
@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2026 GHC contributors
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @brief Synthetic 6LoWPAN traffic generator
+ * Produces reproducible (hdr, payload) pairs for the GHC test and benchmark
+ * tools out of a seed.
+ */
+
+#ifndef GHC_traffic_h
+#define GHC_traffic_h
+
+#include "ghc.h"
+
+#define TRAFFIC_RPL_DIO         0
+#define TRAFFIC_RPL_DAO         1
+#define TRAFFIC_NS              2
+#define TRAFFIC_NA              3
+#define TRAFFIC_COAP_GET        4
+#define TRAFFIC_COAP_OBSERVE    5
+#define TRAFFIC_DTLS_HANDSHAKE  6
+#define TRAFFIC_DTLS_APP        7
+#define TRAFFIC_KINDS           8
+
+#define TRAFFIC_MAX_PAYLOAD     256
+
+typedef struct {
+    unsigned long seed;
+    int mix[TRAFFIC_KINDS];     /* Relative weight of every packet kind */
+    int min_payload;            /* Application data size range of CoAP and DTLS packets */
+    int max_payload;
+    int nodes;                  /* Number of distinct node addresses */
+    int repeat;                 /* Percentage of packets continuing an existing flow */
+} traffic_config_t;
+
+typedef struct {
+    unsigned long seed;         /* 0 if the flow was not started yet */
+    unsigned int sequence;
+} traffic_flow_t;
+
+typedef struct {
+    traffic_config_t config;
+    unsigned long long state;
+    int mix_total;
+    int kind;                   /* Kind of the last generated packet */
+    traffic_flow_t *flows;      /* nodes * TRAFFIC_KINDS entries */
+} traffic_t;
+
+void traffic_default_config(traffic_config_t *config, unsigned long seed);
+int traffic_init(traffic_t *traffic, traffic_config_t *config);
+void traffic_free(traffic_t *traffic);
+int traffic_next(traffic_t *traffic, uint8_t *hdr, uint8_t *payload_buf);
+
+#endif
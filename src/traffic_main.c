@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) 2026 GHC contributors
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * Synthetic 6LoWPAN traffic tool
+ *
+ * Prints generated packets as hex lines (header, payload) or, with -b,
+ * compresses and decompresses them and reports throughput, ratio and
+ * round trip failures.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "traffic.h"
+
+static void usage(const char *name)
+{
+    printf("usage: %s [-s seed] [-n packets] [-m w0,...,w7] [-p min:max] [-a nodes] [-r repeat%%] [-b]\n", name);
+    printf("  mix order: DIO, DAO, NS, NA, CoAP GET, CoAP observe, DTLS handshake, DTLS app data\n");
+}
+
+static void print_hex(uint8_t *buf, int buf_len)
+{
+    for (int x = 0; x < buf_len; x++) {
+        printf("%02x", (unsigned char)buf[x]);
+    }
+}
+
+int main(int argc, char * argv[])
+{
+    uint8_t hdr[40];
+    uint8_t payload[BUFFERSIZE];
+    uint8_t comp_buf[BUFFERSIZE];
+    uint8_t decomp_buf[BUFFERSIZE];
+    traffic_config_t config;
+    traffic_t traffic;
+    long count = 10;
+    int bench = 0;
+    int opt;
+
+    traffic_default_config(&config, 1);
+
+    while ((opt = getopt(argc, argv, "s:n:m:p:a:r:b")) != -1) {
+        switch (opt) {
+            case 's':
+                config.seed = strtoul(optarg, NULL, 0);
+                break;
+            case 'n':
+                count = atol(optarg);
+                break;
+            case 'm':
+                if (sscanf(optarg, "%d,%d,%d,%d,%d,%d,%d,%d", &config.mix[0], &config.mix[1], &config.mix[2],
+                           &config.mix[3], &config.mix[4], &config.mix[5], &config.mix[6], &config.mix[7]) != TRAFFIC_KINDS) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'p':
+                if (sscanf(optarg, "%d:%d", &config.min_payload, &config.max_payload) != 2) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'a':
+                config.nodes = atoi(optarg);
+                break;
+            case 'r':
+                config.repeat = atoi(optarg);
+                break;
+            case 'b':
+                bench = 1;
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (traffic_init(&traffic, &config) != 0) {
+        printf("Invalid configuration\n");
+        usage(argv[0]);
+        return 1;
+    }
+
+    long payload_bytes = 0, compressed_bytes = 0, failures = 0;
+    long kinds[TRAFFIC_KINDS] = { 0 };
+    double seconds = 0;
+
+    for (long n = 0; n < count; n++) {
+        int payload_len = traffic_next(&traffic, hdr, payload);
+
+        if (!bench) {
+            print_hex(hdr, sizeof(hdr));
+            printf(" ");
+            print_hex(payload, payload_len);
+            printf("\n");
+            continue;
+        }
+
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        int comp_buf_len = compress(comp_buf, hdr, payload, payload_len);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        seconds += (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+        decompress(decomp_buf, hdr, comp_buf, comp_buf_len);
+        if (memcmp(&decomp_buf[48], payload, payload_len) != 0) {
+            failures++;
+        }
+        kinds[traffic.kind]++;
+        payload_bytes += payload_len;
+        compressed_bytes += comp_buf_len;
+    }
+
+    if (bench) {
+        printf("packets:     %ld (", count);
+        for (int kind = 0; kind < TRAFFIC_KINDS; kind++) {
+            printf("%s%ld", kind ? "/" : "", kinds[kind]);
+        }
+        printf(")\n");
+        printf("compress:    %.0f packets/s, %.1f ns/packet\n",
+               seconds > 0 ? count / seconds : 0, count > 0 ? seconds * 1e9 / count : 0);
+        printf("ratio:       %.3f (%ld -> %ld bytes)\n",
+               payload_bytes > 0 ? (double)compressed_bytes / payload_bytes : 0, payload_bytes, compressed_bytes);
+        printf("round trip:  %ld failures\n", failures);
+    }
+
+    traffic_free(&traffic);
+    return failures > 0;
+}